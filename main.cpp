@@ -1,5 +1,8 @@
 #define SOKOL_IMPL
 #define SOKOL_GLCORE
+#ifdef SGTRACE_ENABLED
+#define SOKOL_TRACE_HOOKS
+#endif
 #include <array>
 #include <cstdint>
 #include <vector>
@@ -23,12 +26,24 @@
 #include "cgltf/cgltf.h"
 // shaders
 #include "shaders/mainshader.glsl.h"
+#ifdef SGTRACE_ENABLED
+// frame capture for sokol_replay
+#include "sgtrace.h"
+#endif
+#include "meshlet.h"
+#include "static_batch.h"
 
 using namespace std;
 
 struct AppState {
     sg_pipeline pip{};
     sg_bindings bind{};
+    sg_pipeline mesh_pip{};
+    // all static geometry (pos3 + uv2) lives in one vertex/index buffer pair
+    StaticBatch static_batch;
+    uint32_t cube_handle;
+    uint32_t mesh_handle;
+    std::vector<IndexRange> visible_ranges;
     sg_pass_action pass_action{};
     std::array<uint8_t, 512 * 1024> file_buffer{};
     HMM_Vec3 cube_positions[10];
@@ -64,8 +79,13 @@ public:
 
     // Index data
     std::vector<unsigned int> indices;
+
+    // Clusters over indices, built at load time for culling
+    MeshletSet meshlets;
 };
 
+Mesh loaded_mesh;
+
 // Helper to decompose matrix into TRS components
 static void decompose_matrix(const float* matrix, HMM_Vec3& position, HMM_Quat& rotation, HMM_Vec3& scale) {
     // Extract translation
@@ -214,6 +234,13 @@ Mesh load_gltf(const char* path) {
     if (texcoords) free(texcoords);
     cgltf_free(data);
 
+    // Split into meshlets for per-cluster culling
+    if (!build_meshlets(mesh.vertices, 5, mesh.indices, mesh.meshlets)) {
+        std::cout << path << ": index out of range, not drawing the mesh" << std::endl;
+        mesh.vertices.clear();
+        mesh.indices.clear();
+    }
+
     return mesh;
 }
 
@@ -221,6 +248,9 @@ void init() {
     sg_desc desc = {};
     desc.environment = sglue_environment();
     sg_setup(&desc);
+#ifdef SGTRACE_ENABLED
+    sgtrace_setup();
+#endif
     stm_setup();
 
     // flip images after loading
@@ -228,7 +258,7 @@ void init() {
 
     sapp_show_mouse(false);
 
-    Mesh loaded_mesh = load_gltf("test.glb");;
+    loaded_mesh = load_gltf("test.glb");
 
     state.camera_pos = HMM_V3(0.0f, 0.0f, 3.0f);
     state.camera_front = HMM_V3(0.0f, 0.0f, -1.0f);
@@ -315,11 +345,8 @@ void init() {
         -0.5f,  0.5f,  0.5f, 0.0f, 0.0f,
         -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
     };
-    sg_buffer_desc vbuf_desc = {};
-    vbuf_desc.size = sizeof(vertices);
-    vbuf_desc.data = SG_RANGE(vertices);
-    vbuf_desc.label = "cube-vertices";
-    state.bind.vertex_buffers[0] = sg_make_buffer(&vbuf_desc);
+    state.static_batch = static_batch_make(5, "static-vertices", "static-indices");
+    state.cube_handle = static_batch_add(state.static_batch, std::vector<float>(std::begin(vertices), std::end(vertices)), {});
 
     sg_shader shd = sg_make_shader(simple_shader_desc(sg_query_backend()));
 
@@ -331,11 +358,29 @@ void init() {
     pip_desc.layout.attrs[ATTR_simple_aTexCoord].format = SG_VERTEXFORMAT_FLOAT2;
     pip_desc.depth.compare = SG_COMPAREFUNC_LESS_EQUAL;
     pip_desc.depth.write_enabled = true;
+    pip_desc.index_type = SG_INDEXTYPE_UINT32;
     // TODO: add cull mode when model loading comes
     //pip_desc.cull_mode = SG_CULLMODE_BACK;
     pip_desc.label = "cube-pipeline";
     state.pip = sg_make_pipeline(&pip_desc);
 
+    // loaded mesh, drawn with back-face culling. the batch rejects meshes with
+    // out of range indices, those don't get a pipeline and are never drawn
+    if (!loaded_mesh.vertices.empty()) {
+        state.mesh_handle = static_batch_add(state.static_batch, loaded_mesh.vertices, loaded_mesh.indices);
+        if (state.static_batch.ranges[state.mesh_handle].index_count > 0) {
+            sg_pipeline_desc mesh_pip_desc = pip_desc;
+            mesh_pip_desc.cull_mode = SG_CULLMODE_BACK;
+            mesh_pip_desc.face_winding = SG_FACEWINDING_CCW;
+            mesh_pip_desc.label = "mesh-pipeline";
+            state.mesh_pip = sg_make_pipeline(&mesh_pip_desc);
+        }
+    }
+
+    static_batch_upload(state.static_batch);
+    state.bind.vertex_buffers[0] = state.static_batch.vbuf;
+    state.bind.index_buffer = state.static_batch.ibuf;
+
     state.pass_action.colors[0].load_action = SG_LOADACTION_CLEAR;
     state.pass_action.colors[0].clear_value = { 0.2f, 0.3f, 0.3f, 1.0f };
 
@@ -355,6 +400,9 @@ void init() {
 }
 
 void frame(void) {
+#ifdef SGTRACE_ENABLED
+    sgtrace_begin_frame();
+#endif
     state.delta_time = stm_laptime(&state.last_time);
     sfetch_dowork();
     sg_pass pass = {};
@@ -392,6 +440,7 @@ void frame(void) {
         .projection = projection
     };
 
+    const BatchRange& cube = state.static_batch.ranges[state.cube_handle];
     for(size_t i = 0; i < 10; i++) {
         HMM_Mat4 model = HMM_Translate(state.cube_positions[i]);
         float angle = 20.0f * i;
@@ -399,13 +448,45 @@ void frame(void) {
         vs_params.model = model;
         sg_apply_uniforms(UB_vs_params, SG_RANGE(vs_params));
 
-        sg_draw(0, 36, 1);
+        sg_draw((int)cube.first_index, (int)cube.index_count, 1);
+    }
+
+    if (state.mesh_pip.id != SG_INVALID_ID) {
+        HMM_Mat4 model = HMM_MulM4(HMM_Translate(loaded_mesh.position),
+                                   HMM_MulM4(HMM_QToM4(loaded_mesh.rotation), HMM_Scale(loaded_mesh.scale)));
+
+        // only submit the meshlets that are on screen and facing the camera
+        // (non-indexed meshes have no meshlets, the batch gave them 0..n-1 indices)
+        const BatchRange& mesh = state.static_batch.ranges[state.mesh_handle];
+        state.visible_ranges.clear();
+        if (loaded_mesh.meshlets.count > 0) {
+            HMM_Mat4 mvp = HMM_MulM4(projection, HMM_MulM4(view, model));
+            HMM_Vec4 camera_local = HMM_MulM4V4(HMM_InvGeneralM4(model), HMM_V4V(state.camera_pos, 1.0f));
+            cull_meshlets(loaded_mesh.meshlets, mvp, camera_local.XYZ, state.visible_ranges);
+        } else {
+            state.visible_ranges.push_back({ 0, mesh.index_count });
+        }
+
+        if (!state.visible_ranges.empty()) {
+            // same buffers as the cubes, sokol just wants bindings again after a pipeline switch
+            sg_apply_pipeline(state.mesh_pip);
+            sg_apply_bindings(&state.bind);
+            vs_params.model = model;
+            sg_apply_uniforms(UB_vs_params, SG_RANGE(vs_params));
+            for (const IndexRange& range : state.visible_ranges) {
+                sg_draw((int)(mesh.first_index + range.first), (int)range.count, 1);
+            }
+        }
     }
     sg_end_pass();
     sg_commit();
 }
 
 void cleanup(void) {
+    static_batch_destroy(state.static_batch);
+#ifdef SGTRACE_ENABLED
+    sgtrace_shutdown();
+#endif
     sg_shutdown();
     sfetch_shutdown();
 }
@@ -426,6 +507,13 @@ void event(const sapp_event* e) {
             sapp_show_mouse(!mouse_shown);
         }
 
+#ifdef SGTRACE_ENABLED
+        // dump the next frame for sokol_replay
+        if (e->key_code == SAPP_KEYCODE_F9) {
+            sgtrace_request("frame.sgtrace");
+        }
+#endif
+
     } else if (e->type == SAPP_EVENTTYPE_KEY_UP) {
         state.inputs[e->key_code] = false;
     }  else if (e->type == SAPP_EVENTTYPE_MOUSE_MOVE && state.mouse_btn) {
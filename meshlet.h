@@ -0,0 +1,282 @@
+#pragma once
+// meshlets: splits a mesh's index list into small clusters with a bounding
+// sphere and a normal cone each, so whole clusters that are off-screen or
+// facing away from the camera can be skipped before submission.
+//
+// build_meshlets() runs once at load time, cull_meshlets() every frame. The
+// culler works in the mesh's local space (frustum planes come straight out of
+// the model-view-projection matrix) so it doesn't care about the mesh
+// transform, non-uniform scale included.
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "HandmadeMath/HandmadeMath.h"
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MESHLET_SSE
+#endif
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+// a culled run this short (in meshlets) gets drawn anyway rather than
+// splitting a draw; the GPU's own back-face/clip rejection handles them
+constexpr uint32_t MESHLET_MERGE_GAP = 1;
+// past this many draws per mesh one whole-range draw is cheaper
+constexpr size_t MESHLET_MAX_RANGES = 32;
+
+// cluster bounds in SoA layout, padded to a multiple of 4 so the culler can
+// always work on full groups of 4 (one SSE register). padding entries have a
+// negative radius and never pass the frustum test.
+struct MeshletSet {
+    uint32_t count = 0;
+    std::vector<float> center_x, center_y, center_z, radius;
+    std::vector<float> axis_x, axis_y, axis_z, cutoff;
+    // triangles of a meshlet are a contiguous run in the mesh's index buffer
+    std::vector<uint32_t> first_index;
+    std::vector<uint32_t> index_count;
+};
+
+struct IndexRange {
+    uint32_t first;
+    uint32_t count;
+};
+
+inline void meshlet_push(MeshletSet& set, const std::vector<float>& vertices, int stride,
+                         const std::vector<unsigned int>& indices, uint32_t first, uint32_t count) {
+    // bounding sphere around the center of the cluster's AABB
+    HMM_Vec3 lo = HMM_V3(FLT_MAX, FLT_MAX, FLT_MAX);
+    HMM_Vec3 hi = HMM_V3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (uint32_t i = first; i < first + count; i++) {
+        const float* p = &vertices[(size_t)indices[i] * stride];
+        lo = HMM_V3(fminf(lo.X, p[0]), fminf(lo.Y, p[1]), fminf(lo.Z, p[2]));
+        hi = HMM_V3(fmaxf(hi.X, p[0]), fmaxf(hi.Y, p[1]), fmaxf(hi.Z, p[2]));
+    }
+    HMM_Vec3 center = HMM_MulV3F(HMM_AddV3(lo, hi), 0.5f);
+    float radius = 0.0f;
+    for (uint32_t i = first; i < first + count; i++) {
+        const float* p = &vertices[(size_t)indices[i] * stride];
+        radius = fmaxf(radius, HMM_LenV3(HMM_SubV3(HMM_V3(p[0], p[1], p[2]), center)));
+    }
+
+    // normal cone: average of the (CCW) triangle normals, widened until it
+    // contains all of them
+    std::vector<HMM_Vec3> normals;
+    normals.reserve(count / 3);
+    HMM_Vec3 sum = HMM_V3(0.0f, 0.0f, 0.0f);
+    for (uint32_t i = first; i + 2 < first + count; i += 3) {
+        const float* a = &vertices[(size_t)indices[i + 0] * stride];
+        const float* b = &vertices[(size_t)indices[i + 1] * stride];
+        const float* c = &vertices[(size_t)indices[i + 2] * stride];
+        HMM_Vec3 n = HMM_Cross(HMM_V3(b[0] - a[0], b[1] - a[1], b[2] - a[2]),
+                               HMM_V3(c[0] - a[0], c[1] - a[1], c[2] - a[2]));
+        float len = HMM_LenV3(n);
+        if (len <= 1e-12f) {
+            continue;  // degenerate triangles can face any direction
+        }
+        n = HMM_DivV3F(n, len);
+        normals.push_back(n);
+        sum = HMM_AddV3(sum, n);
+    }
+
+    HMM_Vec3 axis = HMM_V3(0.0f, 0.0f, 0.0f);
+    float cutoff = 1.0f;  // 1 means the cone never culls
+    float sum_len = HMM_LenV3(sum);
+    if (sum_len > 1e-6f) {
+        axis = HMM_DivV3F(sum, sum_len);
+        float min_dp = 1.0f;
+        for (const HMM_Vec3& n : normals) {
+            min_dp = fminf(min_dp, HMM_DotV3(n, axis));
+        }
+        // cones wider than ~84 degrees are almost never fully back-facing
+        if (min_dp > 0.1f) {
+            cutoff = sqrtf(1.0f - min_dp * min_dp);
+        }
+    }
+
+    set.center_x.push_back(center.X);
+    set.center_y.push_back(center.Y);
+    set.center_z.push_back(center.Z);
+    set.radius.push_back(radius);
+    set.axis_x.push_back(axis.X);
+    set.axis_y.push_back(axis.Y);
+    set.axis_z.push_back(axis.Z);
+    set.cutoff.push_back(cutoff);
+    set.first_index.push_back(first);
+    set.index_count.push_back(count);
+    set.count += 1;
+}
+
+// greedily walks the triangles in index order and starts a new meshlet
+// whenever the current one would exceed MESHLET_MAX_VERTICES unique vertices
+// or MESHLET_MAX_TRIANGLES triangles. exporters usually hand out indices in a
+// cache friendly order already, which keeps the clusters spatially compact.
+// 'stride' is in floats, positions are the first 3 floats of each vertex.
+// returns false (and an empty 'set') if an index is out of range, such a mesh
+// must not be drawn at all.
+inline bool build_meshlets(const std::vector<float>& vertices, int stride,
+                           const std::vector<unsigned int>& indices, MeshletSet& set) {
+    set = MeshletSet();
+    const size_t vertex_count = vertices.size() / stride;
+    const uint32_t triangle_end = (uint32_t)(indices.size() / 3 * 3);
+
+    // last meshlet each vertex was added to
+    std::vector<uint32_t> seen(vertex_count, UINT32_MAX);
+    uint32_t first = 0;
+    uint32_t unique = 0;
+    uint32_t meshlet = 0;
+    for (uint32_t i = 0; i < triangle_end; i += 3) {
+        uint32_t fresh = 0;
+        for (uint32_t k = 0; k < 3; k++) {
+            unsigned int v = indices[i + k];
+            if (v >= vertex_count) {
+                set = MeshletSet();
+                return false;
+            }
+            if (seen[v] != meshlet) {
+                fresh += 1;
+            }
+        }
+        if (unique + fresh > MESHLET_MAX_VERTICES || (i - first) / 3 + 1 > MESHLET_MAX_TRIANGLES) {
+            meshlet_push(set, vertices, stride, indices, first, i - first);
+            first = i;
+            unique = 0;
+            meshlet += 1;
+        }
+        for (uint32_t k = 0; k < 3; k++) {
+            unsigned int v = indices[i + k];
+            if (seen[v] != meshlet) {
+                seen[v] = meshlet;
+                unique += 1;
+            }
+        }
+    }
+    if (triangle_end > first) {
+        meshlet_push(set, vertices, stride, indices, first, triangle_end - first);
+    }
+
+    while (set.center_x.size() % 4 != 0) {
+        set.center_x.push_back(0.0f);
+        set.center_y.push_back(0.0f);
+        set.center_z.push_back(0.0f);
+        set.radius.push_back(-FLT_MAX);
+        set.axis_x.push_back(0.0f);
+        set.axis_y.push_back(0.0f);
+        set.axis_z.push_back(0.0f);
+        set.cutoff.push_back(1.0f);
+    }
+    return true;
+}
+
+// frustum planes (a, b, c, d) out of the clip matrix rows, normalized
+inline void meshlet_frustum_planes(const HMM_Mat4& mvp, float planes[6][4]) {
+    for (int p = 0; p < 6; p++) {
+        int row = p / 2;
+        float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+        for (int c = 0; c < 4; c++) {
+            planes[p][c] = mvp.Elements[c][3] + sign * mvp.Elements[c][row];
+        }
+        float len = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+        if (len > 0.0f) {
+            for (int c = 0; c < 4; c++) {
+                planes[p][c] /= len;
+            }
+        }
+    }
+}
+
+// visibility of meshlets base..base+3 as a lane mask. the sums are grouped the
+// same way as in the SSE version, so both give the same result to the bit.
+inline int meshlet_visible4_scalar(const MeshletSet& set, uint32_t base, const float planes[6][4], HMM_Vec3 camera) {
+    int mask = 0;
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        const uint32_t m = base + lane;
+        const float cx = set.center_x[m], cy = set.center_y[m], cz = set.center_z[m], r = set.radius[m];
+        bool visible = true;
+        for (int p = 0; p < 6 && visible; p++) {
+            visible = (cx * planes[p][0] + cy * planes[p][1]) + (cz * planes[p][2] + planes[p][3]) >= -r;
+        }
+        const float dx = cx - camera.X, dy = cy - camera.Y, dz = cz - camera.Z;
+        const float dist = sqrtf(dx * dx + dy * dy + dz * dz);
+        const float dp = dx * set.axis_x[m] + dy * set.axis_y[m] + dz * set.axis_z[m];
+        if (visible && !(dp >= set.cutoff[m] * dist + r)) {
+            mask |= 1 << lane;
+        }
+    }
+    return mask;
+}
+
+#if defined(MESHLET_SSE)
+inline int meshlet_visible4_sse(const MeshletSet& set, uint32_t base, const float planes[6][4], HMM_Vec3 camera) {
+    const __m128 cx = _mm_loadu_ps(&set.center_x[base]);
+    const __m128 cy = _mm_loadu_ps(&set.center_y[base]);
+    const __m128 cz = _mm_loadu_ps(&set.center_z[base]);
+    const __m128 r = _mm_loadu_ps(&set.radius[base]);
+    const __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), r);
+
+    // inside (or touching) all six planes
+    __m128 visible = _mm_cmpeq_ps(r, r);
+    for (int p = 0; p < 6; p++) {
+        __m128 dist = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(planes[p][0])), _mm_mul_ps(cy, _mm_set1_ps(planes[p][1]))),
+            _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(planes[p][2])), _mm_set1_ps(planes[p][3])));
+        visible = _mm_and_ps(visible, _mm_cmpge_ps(dist, neg_r));
+    }
+
+    // back-facing: dot(center - camera, axis) >= cutoff * |center - camera| + radius
+    const __m128 dx = _mm_sub_ps(cx, _mm_set1_ps(camera.X));
+    const __m128 dy = _mm_sub_ps(cy, _mm_set1_ps(camera.Y));
+    const __m128 dz = _mm_sub_ps(cz, _mm_set1_ps(camera.Z));
+    const __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+    const __m128 dp = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&set.axis_x[base])), _mm_mul_ps(dy, _mm_loadu_ps(&set.axis_y[base]))),
+        _mm_mul_ps(dz, _mm_loadu_ps(&set.axis_z[base])));
+    const __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&set.cutoff[base]), dist), r);
+    visible = _mm_andnot_ps(_mm_cmpge_ps(dp, limit), visible);
+    return _mm_movemask_ps(visible);
+}
+#endif
+
+// appends the visible meshlets to 'out' as index ranges. ranges separated by
+// at most MESHLET_MERGE_GAP culled meshlets are merged, and if there are still
+// more than MESHLET_MAX_RANGES they collapse into one range spanning them all.
+// 'mvp' is projection * view * model and 'camera' the camera position in the
+// mesh's local space. 'scalar' skips the SSE path, for comparing the two.
+inline void cull_meshlets(const MeshletSet& set, const HMM_Mat4& mvp, HMM_Vec3 camera,
+                          std::vector<IndexRange>& out, bool scalar = false) {
+    float planes[6][4];
+    meshlet_frustum_planes(mvp, planes);
+
+    const size_t out_start = out.size();
+    uint32_t last = 0;  // last emitted meshlet, valid once out has grown
+    auto emit = [&](uint32_t m) {
+        uint32_t end = set.first_index[m] + set.index_count[m];
+        if (out.size() > out_start && m - last - 1 <= MESHLET_MERGE_GAP) {
+            out.back().count = end - out.back().first;
+        } else {
+            out.push_back({ set.first_index[m], set.index_count[m] });
+        }
+        last = m;
+    };
+
+    for (uint32_t base = 0; base < set.count; base += 4) {
+#if defined(MESHLET_SSE)
+        int mask = scalar ? meshlet_visible4_scalar(set, base, planes, camera)
+                          : meshlet_visible4_sse(set, base, planes, camera);
+#else
+        (void)scalar;
+        int mask = meshlet_visible4_scalar(set, base, planes, camera);
+#endif
+        for (uint32_t lane = 0; lane < 4 && base + lane < set.count; lane++) {
+            if (mask & (1 << lane)) {
+                emit(base + lane);
+            }
+        }
+    }
+
+    if (out.size() - out_start > MESHLET_MAX_RANGES) {
+        IndexRange all = { out[out_start].first, out.back().first + out.back().count - out[out_start].first };
+        out.resize(out_start);
+        out.push_back(all);
+    }
+}
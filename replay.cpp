@@ -0,0 +1,583 @@
+// sokol_replay: re-executes a frame captured with sgtrace.h as fast as possible
+// and reports the CPU cost of every sg_* call. capture needs the renderer built
+// with -DSGTRACE_ENABLED=ON, then F9 writes frame.sgtrace.
+//
+//   sokol_replay <trace> [iterations] [--no-validation]
+//
+// the default build runs headless on sokol_gfx's dummy backend, which measures
+// sokol's own per-call overhead. sokol_replay_gl (REPLAY_GLCORE) opens a window
+// and replays one iteration per frame on GL, so the numbers include the driver.
+//
+// every iteration starts from the same state: resources the frame creates are
+// destroyed after it, and setup resources it destroys are made again.
+#define SOKOL_IMPL
+#if defined(REPLAY_GLCORE)
+#define SOKOL_GLCORE
+#else
+#define SOKOL_DUMMY_BACKEND
+#endif
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#if defined(REPLAY_GLCORE)
+#include "sokol/sokol_app.h"
+#endif
+#include "sokol/sokol_gfx.h"
+#if defined(REPLAY_GLCORE)
+#include "sokol/sokol_glue.h"
+#endif
+#include "sokol/sokol_time.h"
+#ifdef B32
+#undef B32
+#endif
+#include "HandmadeMath/HandmadeMath.h"
+// shaders
+#include "shaders/mainshader.glsl.h"
+#include "sgtrace.h"
+
+using namespace std;
+
+struct OpStats {
+    uint64_t calls;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+};
+
+struct ReplayState {
+    string path;
+    int iterations = 100;
+    int iterations_done = 0;
+    bool disable_validation = false;
+    vector<uint8_t> trace;
+    // first record after SGTRACE_OP_FRAME_START
+    const uint8_t* frame_begin = nullptr;
+    // recorded id -> id in this process, one map per resource pool
+    unordered_map<uint32_t, uint32_t> buffers;
+    unordered_map<uint32_t, uint32_t> images;
+    unordered_map<uint32_t, uint32_t> samplers;
+    unordered_map<uint32_t, uint32_t> shaders;
+    unordered_map<uint32_t, uint32_t> pipelines;
+    // resources the frame itself created, destroyed again after each iteration
+    vector<pair<sgtrace_op, uint32_t>> frame_resources;
+    // creation records of the setup section by (make op, recorded id), and
+    // the ones the frame destroyed, made again after each iteration
+    map<pair<sgtrace_op, uint32_t>, sgtrace_reader> setup_records;
+    vector<pair<sgtrace_op, uint32_t>> setup_destroyed;
+    bool in_frame = false;
+    // trace loaded and setup section replayed
+    bool ready = false;
+    array<OpStats, SGTRACE_OP_NUM> stats{};
+    uint64_t frame_ticks = 0;
+};
+
+ReplayState state;
+
+// shader descs aren't stored in the trace, only their label
+static const sg_shader_desc* find_shader_desc(const string& label) {
+#if defined(REPLAY_GLCORE)
+    sg_backend backend = sg_query_backend();
+#else
+    // the dummy backend ignores the shader code but still validates against
+    // the reflection info, which is the same for every backend
+    sg_backend backend = SG_BACKEND_GLCORE;
+#endif
+    if (label == "simple_shader") {
+        return simple_shader_desc(backend);
+    }
+    return nullptr;
+}
+
+static uint32_t remap(const unordered_map<uint32_t, uint32_t>& ids, uint32_t id) {
+    auto it = ids.find(id);
+    return it != ids.end() ? it->second : (uint32_t)SG_INVALID_ID;
+}
+
+template<typename F>
+static void timed(sgtrace_op op, F&& call) {
+    uint64_t start = stm_now();
+    call();
+    uint64_t ticks = stm_since(start);
+    if (!state.in_frame) {
+        return;
+    }
+    OpStats& s = state.stats[op];
+    if (s.calls == 0 || ticks < s.min) {
+        s.min = ticks;
+    }
+    if (ticks > s.max) {
+        s.max = ticks;
+    }
+    s.calls += 1;
+    s.total += ticks;
+}
+
+static void created(sgtrace_op op, unordered_map<uint32_t, uint32_t>& ids, uint32_t recorded_id, uint32_t id) {
+    ids[recorded_id] = id;
+    if (state.in_frame) {
+        state.frame_resources.emplace_back(op, id);
+    }
+}
+
+// 'op' is the make op of the destroyed resource
+static void destroyed(sgtrace_op op, uint32_t recorded_id) {
+    if (state.in_frame && state.setup_records.count({ op, recorded_id }) > 0) {
+        state.setup_destroyed.emplace_back(op, recorded_id);
+    }
+}
+
+static bool replay_record(sgtrace_op op, sgtrace_reader in) {
+    uint32_t id = 0;
+    switch (op) {
+        case SGTRACE_OP_MAKE_BUFFER: {
+            sg_buffer_desc desc;
+            if (!in.get(id) || !in.get(desc)) {
+                return false;
+            }
+            if (desc.data.size > 0) {
+                desc.data.ptr = in.skip(desc.data.size);
+                if (!desc.data.ptr) {
+                    return false;
+                }
+            }
+            sg_buffer buf{};
+            timed(op, [&] { buf = sg_make_buffer(&desc); });
+            created(op, state.buffers, id, buf.id);
+            break;
+        }
+        case SGTRACE_OP_MAKE_IMAGE: {
+            sg_image_desc desc;
+            if (!in.get(id) || !in.get(desc)) {
+                return false;
+            }
+            if (!sgtrace_get_image_pixels(in, desc.data)) {
+                return false;
+            }
+            sg_image img{};
+            timed(op, [&] { img = sg_make_image(&desc); });
+            created(op, state.images, id, img.id);
+            break;
+        }
+        case SGTRACE_OP_MAKE_SAMPLER: {
+            sg_sampler_desc desc;
+            if (!in.get(id) || !in.get(desc)) {
+                return false;
+            }
+            sg_sampler smp{};
+            timed(op, [&] { smp = sg_make_sampler(&desc); });
+            created(op, state.samplers, id, smp.id);
+            break;
+        }
+        case SGTRACE_OP_MAKE_SHADER: {
+            if (!in.get(id)) {
+                return false;
+            }
+            string label(reinterpret_cast<const char*>(in.ptr), (size_t)(in.end - in.ptr));
+            const sg_shader_desc* desc = find_shader_desc(label);
+            if (!desc) {
+                cout << "unknown shader '" << label << "' in trace" << endl;
+                return false;
+            }
+            sg_shader shd{};
+            timed(op, [&] { shd = sg_make_shader(desc); });
+            created(op, state.shaders, id, shd.id);
+            break;
+        }
+        case SGTRACE_OP_MAKE_PIPELINE: {
+            sg_pipeline_desc desc;
+            if (!in.get(id) || !in.get(desc)) {
+                return false;
+            }
+            desc.shader.id = remap(state.shaders, desc.shader.id);
+            sg_pipeline pip{};
+            timed(op, [&] { pip = sg_make_pipeline(&desc); });
+            created(op, state.pipelines, id, pip.id);
+            break;
+        }
+        case SGTRACE_OP_DESTROY_BUFFER: {
+            if (!in.get(id)) {
+                return false;
+            }
+            sg_buffer buf = { remap(state.buffers, id) };
+            timed(op, [&] { sg_destroy_buffer(buf); });
+            destroyed(SGTRACE_OP_MAKE_BUFFER, id);
+            break;
+        }
+        case SGTRACE_OP_DESTROY_IMAGE: {
+            if (!in.get(id)) {
+                return false;
+            }
+            sg_image img = { remap(state.images, id) };
+            timed(op, [&] { sg_destroy_image(img); });
+            destroyed(SGTRACE_OP_MAKE_IMAGE, id);
+            break;
+        }
+        case SGTRACE_OP_DESTROY_SAMPLER: {
+            if (!in.get(id)) {
+                return false;
+            }
+            sg_sampler smp = { remap(state.samplers, id) };
+            timed(op, [&] { sg_destroy_sampler(smp); });
+            destroyed(SGTRACE_OP_MAKE_SAMPLER, id);
+            break;
+        }
+        case SGTRACE_OP_DESTROY_SHADER: {
+            if (!in.get(id)) {
+                return false;
+            }
+            sg_shader shd = { remap(state.shaders, id) };
+            timed(op, [&] { sg_destroy_shader(shd); });
+            destroyed(SGTRACE_OP_MAKE_SHADER, id);
+            break;
+        }
+        case SGTRACE_OP_DESTROY_PIPELINE: {
+            if (!in.get(id)) {
+                return false;
+            }
+            sg_pipeline pip = { remap(state.pipelines, id) };
+            timed(op, [&] { sg_destroy_pipeline(pip); });
+            destroyed(SGTRACE_OP_MAKE_PIPELINE, id);
+            break;
+        }
+        case SGTRACE_OP_UPDATE_BUFFER: {
+            if (!in.get(id)) {
+                return false;
+            }
+            sg_buffer buf = { remap(state.buffers, id) };
+            sg_range data = { in.ptr, (size_t)(in.end - in.ptr) };
+            timed(op, [&] { sg_update_buffer(buf, &data); });
+            break;
+        }
+        case SGTRACE_OP_APPEND_BUFFER: {
+            if (!in.get(id)) {
+                return false;
+            }
+            sg_buffer buf = { remap(state.buffers, id) };
+            sg_range data = { in.ptr, (size_t)(in.end - in.ptr) };
+            timed(op, [&] { sg_append_buffer(buf, &data); });
+            break;
+        }
+        case SGTRACE_OP_UPDATE_IMAGE: {
+            sg_image_data data;
+            if (!in.get(id) || !in.get(data) || !sgtrace_get_image_pixels(in, data)) {
+                return false;
+            }
+            sg_image img = { remap(state.images, id) };
+            timed(op, [&] { sg_update_image(img, &data); });
+            break;
+        }
+        case SGTRACE_OP_APPLY_VIEWPORT:
+        case SGTRACE_OP_APPLY_SCISSOR_RECT: {
+            sgtrace_rect rect;
+            if (!in.get(rect)) {
+                return false;
+            }
+            if (op == SGTRACE_OP_APPLY_VIEWPORT) {
+                timed(op, [&] { sg_apply_viewport(rect.x, rect.y, rect.width, rect.height, rect.origin_top_left != 0); });
+            } else {
+                timed(op, [&] { sg_apply_scissor_rect(rect.x, rect.y, rect.width, rect.height, rect.origin_top_left != 0); });
+            }
+            break;
+        }
+        case SGTRACE_OP_BEGIN_PASS: {
+            sg_pass pass = {};
+            sgtrace_swapchain swapchain;
+            if (!in.get(pass.action) || !in.get(swapchain)) {
+                return false;
+            }
+#if defined(REPLAY_GLCORE)
+            pass.swapchain = sglue_swapchain();
+#else
+            pass.swapchain.width = swapchain.width;
+            pass.swapchain.height = swapchain.height;
+            pass.swapchain.sample_count = swapchain.sample_count;
+            pass.swapchain.color_format = (sg_pixel_format)swapchain.color_format;
+            pass.swapchain.depth_format = (sg_pixel_format)swapchain.depth_format;
+#endif
+            timed(op, [&] { sg_begin_pass(&pass); });
+            break;
+        }
+        case SGTRACE_OP_APPLY_PIPELINE: {
+            if (!in.get(id)) {
+                return false;
+            }
+            sg_pipeline pip = { remap(state.pipelines, id) };
+            timed(op, [&] { sg_apply_pipeline(pip); });
+            break;
+        }
+        case SGTRACE_OP_APPLY_BINDINGS: {
+            sg_bindings bind;
+            if (!in.get(bind)) {
+                return false;
+            }
+            for (auto& vb : bind.vertex_buffers) {
+                vb.id = remap(state.buffers, vb.id);
+            }
+            bind.index_buffer.id = remap(state.buffers, bind.index_buffer.id);
+            for (auto& img : bind.images) {
+                img.id = remap(state.images, img.id);
+            }
+            for (auto& smp : bind.samplers) {
+                smp.id = remap(state.samplers, smp.id);
+            }
+            for (auto& sbuf : bind.storage_buffers) {
+                sbuf.id = remap(state.buffers, sbuf.id);
+            }
+            timed(op, [&] { sg_apply_bindings(&bind); });
+            break;
+        }
+        case SGTRACE_OP_APPLY_UNIFORMS: {
+            int32_t slot;
+            if (!in.get(slot)) {
+                return false;
+            }
+            sg_range data = { in.ptr, (size_t)(in.end - in.ptr) };
+            timed(op, [&] { sg_apply_uniforms(slot, &data); });
+            break;
+        }
+        case SGTRACE_OP_DRAW: {
+            int32_t args[3];
+            if (!in.get(args)) {
+                return false;
+            }
+            timed(op, [&] { sg_draw(args[0], args[1], args[2]); });
+            break;
+        }
+        case SGTRACE_OP_END_PASS:
+            timed(op, [&] { sg_end_pass(); });
+            break;
+        case SGTRACE_OP_COMMIT:
+            timed(op, [&] { sg_commit(); });
+            break;
+        default:
+            cout << "unknown record " << op << " in trace" << endl;
+            return false;
+    }
+    return true;
+}
+
+// runs the setup section from 'ptr' up to SGTRACE_OP_FRAME_START, or the frame
+// from 'ptr' to the end of the trace. a trace has exactly one FRAME_START, a
+// setup section without one or a frame with another is corrupt (nullptr).
+static const uint8_t* replay_records(const uint8_t* ptr, bool setup) {
+    if (!ptr) {
+        return nullptr;
+    }
+    sgtrace_reader in = { ptr, state.trace.data() + state.trace.size() };
+    while (!in.done()) {
+        sgtrace_record rec;
+        if (!in.get(rec)) {
+            return nullptr;
+        }
+        const uint8_t* payload = in.skip(rec.size);
+        if (!payload) {
+            return nullptr;
+        }
+        if (rec.op == SGTRACE_OP_FRAME_START) {
+            return setup ? in.ptr : nullptr;
+        }
+        if (!replay_record((sgtrace_op)rec.op, { payload, payload + rec.size })) {
+            return nullptr;
+        }
+        if (setup && rec.op >= SGTRACE_OP_MAKE_BUFFER && rec.op <= SGTRACE_OP_MAKE_PIPELINE) {
+            uint32_t id = 0;
+            memcpy(&id, payload, sizeof(id));  // replay_record() checked the size
+            state.setup_records[{ (sgtrace_op)rec.op, id }] = { payload, payload + rec.size };
+        }
+    }
+    return setup ? nullptr : in.ptr;
+}
+
+static bool load_trace() {
+    ifstream file(state.path, ios::binary);
+    if (!file) {
+        cout << "failed to open " << state.path << endl;
+        return false;
+    }
+    state.trace.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+
+    sgtrace_header hdr;
+    sgtrace_reader in = { state.trace.data(), state.trace.data() + state.trace.size() };
+    if (!in.get(hdr) || hdr.magic != SGTRACE_MAGIC || hdr.version != SGTRACE_VERSION) {
+        cout << state.path << " is not a frame trace" << endl;
+        return false;
+    }
+    sgtrace_header expected = sgtrace_make_header((sg_backend)hdr.backend);
+    if (memcmp(&hdr, &expected, sizeof(hdr)) != 0) {
+        cout << state.path << " was recorded with a different sokol_gfx.h" << endl;
+        return false;
+    }
+    state.frame_begin = in.ptr;
+    return true;
+}
+
+// creates the resources that were alive when the frame was captured
+static bool replay_setup() {
+    stm_setup();
+    state.frame_begin = replay_records(state.frame_begin, true);
+    if (!state.frame_begin) {
+        cout << "trace is truncated or corrupt" << endl;
+        return false;
+    }
+    return true;
+}
+
+static bool replay_frame() {
+    state.in_frame = true;
+    uint64_t start = stm_now();
+    bool ok = replay_records(state.frame_begin, false) != nullptr;
+    state.frame_ticks += stm_since(start);
+    state.in_frame = false;
+
+    for (auto& [op, id] : state.frame_resources) {
+        switch (op) {
+            case SGTRACE_OP_MAKE_BUFFER: sg_destroy_buffer({ id }); break;
+            case SGTRACE_OP_MAKE_IMAGE: sg_destroy_image({ id }); break;
+            case SGTRACE_OP_MAKE_SAMPLER: sg_destroy_sampler({ id }); break;
+            case SGTRACE_OP_MAKE_SHADER: sg_destroy_shader({ id }); break;
+            case SGTRACE_OP_MAKE_PIPELINE: sg_destroy_pipeline({ id }); break;
+            default: break;
+        }
+    }
+    state.frame_resources.clear();
+
+    // in creation order, pipelines need their shader back first
+    sort(state.setup_destroyed.begin(), state.setup_destroyed.end(), [](const auto& a, const auto& b) {
+        return state.setup_records[a].ptr < state.setup_records[b].ptr;
+    });
+    state.setup_destroyed.erase(unique(state.setup_destroyed.begin(), state.setup_destroyed.end()), state.setup_destroyed.end());
+    for (const auto& key : state.setup_destroyed) {
+        ok = ok && replay_record(key.first, state.setup_records[key]);
+    }
+    state.setup_destroyed.clear();
+    state.iterations_done += 1;
+    return ok;
+}
+
+static void report() {
+    printf("%s: %d iterations on %s, %.3f us per frame\n",
+        state.path.c_str(), state.iterations_done,
+        sg_query_backend() == SG_BACKEND_DUMMY ? "dummy" : "glcore",
+        stm_us(state.frame_ticks) / (state.iterations_done > 0 ? state.iterations_done : 1));
+    printf("%-18s %10s %12s %10s %10s %10s\n", "call", "calls", "total ms", "avg us", "min us", "max us");
+    for (uint32_t op = 0; op < SGTRACE_OP_NUM; op++) {
+        const OpStats& s = state.stats[op];
+        if (s.calls == 0) {
+            continue;
+        }
+        printf("%-18s %10llu %12.3f %10.3f %10.3f %10.3f\n",
+            sgtrace_op_name(op), (unsigned long long)s.calls,
+            stm_ms(s.total), stm_us(s.total) / (double)s.calls, stm_us(s.min), stm_us(s.max));
+    }
+}
+
+static bool parse_args(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-validation") == 0) {
+            state.disable_validation = true;
+        } else if (state.path.empty()) {
+            state.path = argv[i];
+        } else {
+            state.iterations = atoi(argv[i]);
+        }
+    }
+    if (state.path.empty() || state.iterations <= 0) {
+        cout << "usage: " << argv[0] << " <trace> [iterations] [--no-validation]" << endl;
+        return false;
+    }
+    return true;
+}
+
+#if defined(REPLAY_GLCORE)
+
+void init() {
+    sg_desc desc = {};
+    desc.environment = sglue_environment();
+    desc.disable_validation = state.disable_validation;
+    sg_setup(&desc);
+
+    if (!load_trace() || !replay_setup()) {
+        sapp_quit();
+        return;
+    }
+    state.ready = true;
+}
+
+void frame(void) {
+    // sokol_app still runs a frame after a failed init
+    if (!state.ready) {
+        return;
+    }
+    if (!replay_frame()) {
+        cout << "trace is truncated or corrupt" << endl;
+        state.ready = false;
+        sapp_quit();
+        return;
+    }
+    if (state.iterations_done >= state.iterations) {
+        report();
+        sapp_request_quit();
+    }
+}
+
+void cleanup(void) {
+    sg_shutdown();
+}
+
+sapp_desc sokol_main(int argc, char* argv[]) {
+    if (!parse_args(argc, argv)) {
+        exit(1);
+    }
+    sapp_desc desc = {};
+    desc.init_cb = init;
+    desc.frame_cb = frame;
+    desc.cleanup_cb = cleanup;
+    desc.width = 800;
+    desc.height = 600;
+    desc.window_title = "sokol_replay";
+    return desc;
+}
+
+#else
+
+int main(int argc, char* argv[]) {
+    if (!parse_args(argc, argv) || !load_trace()) {
+        return 1;
+    }
+
+    sg_desc desc = {};
+    desc.environment.defaults.color_format = SG_PIXELFORMAT_RGBA8;
+    desc.environment.defaults.depth_format = SG_PIXELFORMAT_DEPTH_STENCIL;
+    desc.environment.defaults.sample_count = 1;
+    desc.disable_validation = state.disable_validation;
+    sg_setup(&desc);
+
+    int result = 0;
+    if (replay_setup()) {
+        for (int i = 0; i < state.iterations; i++) {
+            if (!replay_frame()) {
+                cout << "trace is truncated or corrupt" << endl;
+                result = 1;
+                break;
+            }
+        }
+        report();
+    } else {
+        result = 1;
+    }
+    sg_shutdown();
+    return result;
+}
+
+#endif
@@ -0,0 +1,654 @@
+#pragma once
+// sgtrace: records the sg_* calls of a single frame into a binary trace file,
+// so that sokol_replay can re-run that exact frame headlessly and time it.
+//
+// recording goes through sokol_gfx's trace hooks, so SOKOL_TRACE_HOOKS has to
+// be defined before sokol_gfx.h is included (with the implementation). the
+// renderer only does that when configured with -DSGTRACE_ENABLED=ON, since the
+// recorder keeps a CPU copy of every live resource.
+//
+// file layout:
+//   sgtrace_header
+//   records: [sgtrace_record][payload] ...
+//     - creation records of every resource alive when the capture started
+//     - SGTRACE_OP_FRAME_START
+//     - everything the frame did, up to and including SGTRACE_OP_COMMIT
+//
+// only creation data is kept per resource: a dynamic or stream buffer/image
+// that was updated before the captured frame replays with its initial
+// contents (or none), not the ones it had when the frame started. fine for the
+// CPU timings this is for, as long as the frame updates what it draws from.
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+constexpr uint32_t SGTRACE_MAGIC = 0x52544753;  // "SGTR"
+constexpr uint32_t SGTRACE_VERSION = 2;
+
+enum sgtrace_op : uint32_t {
+    SGTRACE_OP_INVALID = 0,
+    SGTRACE_OP_MAKE_BUFFER,
+    SGTRACE_OP_MAKE_IMAGE,
+    SGTRACE_OP_MAKE_SAMPLER,
+    SGTRACE_OP_MAKE_SHADER,
+    SGTRACE_OP_MAKE_PIPELINE,
+    SGTRACE_OP_DESTROY_BUFFER,
+    SGTRACE_OP_DESTROY_IMAGE,
+    SGTRACE_OP_DESTROY_SAMPLER,
+    SGTRACE_OP_DESTROY_SHADER,
+    SGTRACE_OP_DESTROY_PIPELINE,
+    SGTRACE_OP_UPDATE_BUFFER,
+    SGTRACE_OP_BEGIN_PASS,
+    SGTRACE_OP_APPLY_PIPELINE,
+    SGTRACE_OP_APPLY_BINDINGS,
+    SGTRACE_OP_APPLY_UNIFORMS,
+    SGTRACE_OP_DRAW,
+    SGTRACE_OP_END_PASS,
+    SGTRACE_OP_COMMIT,
+    SGTRACE_OP_FRAME_START,
+    SGTRACE_OP_APPEND_BUFFER,
+    SGTRACE_OP_UPDATE_IMAGE,
+    SGTRACE_OP_APPLY_VIEWPORT,
+    SGTRACE_OP_APPLY_SCISSOR_RECT,
+    SGTRACE_OP_NUM
+};
+
+inline const char* sgtrace_op_name(uint32_t op) {
+    static const char* names[SGTRACE_OP_NUM] = {
+        "invalid",
+        "make_buffer", "make_image", "make_sampler", "make_shader", "make_pipeline",
+        "destroy_buffer", "destroy_image", "destroy_sampler", "destroy_shader", "destroy_pipeline",
+        "update_buffer",
+        "begin_pass", "apply_pipeline", "apply_bindings", "apply_uniforms", "draw", "end_pass", "commit",
+        "frame_start",
+        "append_buffer", "update_image", "apply_viewport", "apply_scissor_rect",
+    };
+    return op < SGTRACE_OP_NUM ? names[op] : "unknown";
+}
+
+// the desc structs are written as raw bytes with their label and data pointers
+// cleared, so a trace only replays against a sokol_gfx.h with the same struct
+// layouts. resources wrapping native handles (gl_*, mtl_*, d3d11_*, wgpu_*)
+// can't be recreated in another process and make the capture abort.
+struct sgtrace_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t backend;
+    uint32_t sizeof_buffer_desc;
+    uint32_t sizeof_image_desc;
+    uint32_t sizeof_sampler_desc;
+    uint32_t sizeof_pipeline_desc;
+    uint32_t sizeof_bindings;
+    uint32_t sizeof_pass_action;
+};
+
+inline sgtrace_header sgtrace_make_header(sg_backend backend) {
+    sgtrace_header hdr = {};
+    hdr.magic = SGTRACE_MAGIC;
+    hdr.version = SGTRACE_VERSION;
+    hdr.backend = (uint32_t)backend;
+    hdr.sizeof_buffer_desc = sizeof(sg_buffer_desc);
+    hdr.sizeof_image_desc = sizeof(sg_image_desc);
+    hdr.sizeof_sampler_desc = sizeof(sg_sampler_desc);
+    hdr.sizeof_pipeline_desc = sizeof(sg_pipeline_desc);
+    hdr.sizeof_bindings = sizeof(sg_bindings);
+    hdr.sizeof_pass_action = sizeof(sg_pass_action);
+    return hdr;
+}
+
+struct sgtrace_record {
+    uint32_t op;
+    uint32_t size;  // payload bytes following this record
+};
+
+// only the parts of sg_swapchain that matter outside the recording process
+struct sgtrace_swapchain {
+    int32_t width;
+    int32_t height;
+    int32_t sample_count;
+    uint32_t color_format;
+    uint32_t depth_format;
+};
+
+// viewport and scissor rect arguments
+struct sgtrace_rect {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    uint32_t origin_top_left;
+};
+
+// payload helpers, shared by the recorder and the replay tool
+inline void sgtrace_put(std::vector<uint8_t>& out, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+template<typename T>
+inline void sgtrace_put(std::vector<uint8_t>& out, const T& value) {
+    sgtrace_put(out, &value, sizeof(T));
+}
+
+inline void sgtrace_begin_record(std::vector<uint8_t>& out, sgtrace_op op) {
+    sgtrace_record rec = { op, 0 };
+    sgtrace_put(out, rec);
+}
+
+// patches the size of the record started at 'start'
+inline void sgtrace_end_record(std::vector<uint8_t>& out, size_t start) {
+    uint32_t size = (uint32_t)(out.size() - start - sizeof(sgtrace_record));
+    memcpy(out.data() + start + offsetof(sgtrace_record, size), &size, sizeof(size));
+}
+
+struct sgtrace_reader {
+    const uint8_t* ptr;
+    const uint8_t* end;
+
+    bool get(void* dst, size_t size) {
+        if ((size_t)(end - ptr) < size) {
+            return false;
+        }
+        memcpy(dst, ptr, size);
+        ptr += size;
+        return true;
+    }
+
+    template<typename T>
+    bool get(T& value) {
+        return get(&value, sizeof(T));
+    }
+
+    // returns a pointer into the trace and skips 'size' bytes
+    const uint8_t* skip(size_t size) {
+        if ((size_t)(end - ptr) < size) {
+            return nullptr;
+        }
+        const uint8_t* p = ptr;
+        ptr += size;
+        return p;
+    }
+
+    bool done() const {
+        return ptr >= end;
+    }
+};
+
+// image data is stored as the sg_image_data struct with its pointers cleared
+// (the sizes stay), followed by the pixels in [face][mip] order
+inline void sgtrace_put_image_pixels(std::vector<uint8_t>& out, const sg_image_data& data) {
+    for (auto& face : data.subimage) {
+        for (auto& mip : face) {
+            if (mip.ptr) {
+                sgtrace_put(out, mip.ptr, mip.size);
+            }
+        }
+    }
+}
+
+inline sg_image_data sgtrace_strip_image_data(const sg_image_data& data) {
+    sg_image_data stripped = data;
+    for (auto& face : stripped.subimage) {
+        for (auto& mip : face) {
+            if (!mip.ptr) {
+                mip.size = 0;
+            }
+            mip.ptr = nullptr;
+        }
+    }
+    return stripped;
+}
+
+// points the ranges of a stripped sg_image_data back at the pixels in the trace
+inline bool sgtrace_get_image_pixels(sgtrace_reader& in, sg_image_data& data) {
+    for (auto& face : data.subimage) {
+        for (auto& mip : face) {
+            if (mip.size > 0) {
+                mip.ptr = in.skip(mip.size);
+                if (!mip.ptr) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// ---- recorder ---------------------------------------------------------------
+#if defined(SOKOL_TRACE_HOOKS)
+
+struct sgtrace_state {
+    // creation records of all live resources, ordered by creation so that
+    // shaders come before the pipelines that use them
+    std::map<uint64_t, std::vector<uint8_t>> live;
+    std::unordered_map<uint64_t, uint64_t> live_seq;
+    // live resources made from injected native handles
+    std::unordered_set<uint64_t> native;
+    uint64_t next_seq;
+    std::vector<uint8_t> frame;
+    std::string path;
+    bool pending;
+    bool recording;
+};
+
+inline sgtrace_state& sgtrace() {
+    static sgtrace_state s;
+    return s;
+}
+
+inline uint64_t sgtrace_key(sgtrace_op op, uint32_t id) {
+    return ((uint64_t)op << 32) | id;
+}
+
+inline void sgtrace_track(sgtrace_op op, uint32_t id, std::vector<uint8_t>&& rec) {
+    sgtrace_state& s = sgtrace();
+    if (s.recording) {
+        sgtrace_put(s.frame, rec.data(), rec.size());
+    }
+    uint64_t seq = s.next_seq++;
+    s.live_seq[sgtrace_key(op, id)] = seq;
+    s.live[seq] = std::move(rec);
+}
+
+inline void sgtrace_untrack(sgtrace_op make_op, sgtrace_op destroy_op, uint32_t id) {
+    sgtrace_state& s = sgtrace();
+    auto it = s.live_seq.find(sgtrace_key(make_op, id));
+    if (it == s.live_seq.end()) {
+        return;
+    }
+    s.live.erase(it->second);
+    s.live_seq.erase(it);
+    s.native.erase(sgtrace_key(make_op, id));
+    if (s.recording) {
+        size_t start = s.frame.size();
+        sgtrace_begin_record(s.frame, destroy_op);
+        sgtrace_put(s.frame, id);
+        sgtrace_end_record(s.frame, start);
+    }
+}
+
+// drops the frame being recorded, for calls the trace can't replay faithfully
+inline void sgtrace_abort(const char* reason) {
+    sgtrace_state& s = sgtrace();
+    std::cout << "frame capture aborted: " << reason << std::endl;
+    s.recording = false;
+    s.frame.clear();
+    s.frame.shrink_to_fit();
+}
+
+inline bool sgtrace_has_native(const sg_buffer_desc& d) {
+    for (int i = 0; i < SG_NUM_INFLIGHT_FRAMES; i++) {
+        if (d.gl_buffers[i] != 0 || d.mtl_buffers[i] != nullptr) {
+            return true;
+        }
+    }
+    return d.d3d11_buffer != nullptr || d.wgpu_buffer != nullptr;
+}
+
+inline bool sgtrace_has_native(const sg_image_desc& d) {
+    for (int i = 0; i < SG_NUM_INFLIGHT_FRAMES; i++) {
+        if (d.gl_textures[i] != 0 || d.mtl_textures[i] != nullptr) {
+            return true;
+        }
+    }
+    return d.d3d11_texture != nullptr || d.d3d11_shader_resource_view != nullptr ||
+           d.wgpu_texture != nullptr || d.wgpu_texture_view != nullptr;
+}
+
+inline bool sgtrace_has_native(const sg_sampler_desc& d) {
+    return d.gl_sampler != 0 || d.mtl_sampler != nullptr || d.d3d11_sampler != nullptr || d.wgpu_sampler != nullptr;
+}
+
+// still tracked like any other resource, but a capture can't start (or go on)
+// while one of these is alive
+inline void sgtrace_track_native(sgtrace_op op, uint32_t id) {
+    sgtrace_state& s = sgtrace();
+    s.native.insert(sgtrace_key(op, id));
+    if (s.recording) {
+        sgtrace_abort("resources wrapping native handles are not supported");
+    }
+}
+
+inline void sgtrace_make_buffer(const sg_buffer_desc* desc, sg_buffer result, void*) {
+    if (result.id == SG_INVALID_ID) {
+        return;
+    }
+    sg_buffer_desc d = *desc;
+    if (!d.data.ptr) {
+        d.data.size = 0;
+    }
+    d.data.ptr = nullptr;
+    d.label = nullptr;
+
+    std::vector<uint8_t> rec;
+    sgtrace_begin_record(rec, SGTRACE_OP_MAKE_BUFFER);
+    sgtrace_put(rec, result.id);
+    sgtrace_put(rec, d);
+    if (desc->data.ptr) {
+        sgtrace_put(rec, desc->data.ptr, desc->data.size);
+    }
+    sgtrace_end_record(rec, 0);
+    sgtrace_track(SGTRACE_OP_MAKE_BUFFER, result.id, std::move(rec));
+    if (sgtrace_has_native(*desc)) {
+        sgtrace_track_native(SGTRACE_OP_MAKE_BUFFER, result.id);
+    }
+}
+
+inline void sgtrace_make_image(const sg_image_desc* desc, sg_image result, void*) {
+    if (result.id == SG_INVALID_ID) {
+        return;
+    }
+    sg_image_desc d = *desc;
+    d.label = nullptr;
+    d.data = sgtrace_strip_image_data(desc->data);
+
+    std::vector<uint8_t> rec;
+    sgtrace_begin_record(rec, SGTRACE_OP_MAKE_IMAGE);
+    sgtrace_put(rec, result.id);
+    sgtrace_put(rec, d);
+    sgtrace_put_image_pixels(rec, desc->data);
+    sgtrace_end_record(rec, 0);
+    sgtrace_track(SGTRACE_OP_MAKE_IMAGE, result.id, std::move(rec));
+    if (sgtrace_has_native(*desc)) {
+        sgtrace_track_native(SGTRACE_OP_MAKE_IMAGE, result.id);
+    }
+}
+
+inline void sgtrace_make_sampler(const sg_sampler_desc* desc, sg_sampler result, void*) {
+    if (result.id == SG_INVALID_ID) {
+        return;
+    }
+    sg_sampler_desc d = *desc;
+    d.label = nullptr;
+
+    std::vector<uint8_t> rec;
+    sgtrace_begin_record(rec, SGTRACE_OP_MAKE_SAMPLER);
+    sgtrace_put(rec, result.id);
+    sgtrace_put(rec, d);
+    sgtrace_end_record(rec, 0);
+    sgtrace_track(SGTRACE_OP_MAKE_SAMPLER, result.id, std::move(rec));
+    if (sgtrace_has_native(*desc)) {
+        sgtrace_track_native(SGTRACE_OP_MAKE_SAMPLER, result.id);
+    }
+}
+
+// shader descs are full of backend specific source/bytecode pointers, so only
+// the label is stored; the replay tool looks it up among the shdc shaders it
+// was built with
+inline void sgtrace_make_shader(const sg_shader_desc* desc, sg_shader result, void*) {
+    if (result.id == SG_INVALID_ID) {
+        return;
+    }
+    const char* label = desc->label ? desc->label : "";
+
+    std::vector<uint8_t> rec;
+    sgtrace_begin_record(rec, SGTRACE_OP_MAKE_SHADER);
+    sgtrace_put(rec, result.id);
+    sgtrace_put(rec, label, strlen(label));
+    sgtrace_end_record(rec, 0);
+    sgtrace_track(SGTRACE_OP_MAKE_SHADER, result.id, std::move(rec));
+}
+
+inline void sgtrace_make_pipeline(const sg_pipeline_desc* desc, sg_pipeline result, void*) {
+    if (result.id == SG_INVALID_ID) {
+        return;
+    }
+    sg_pipeline_desc d = *desc;
+    d.label = nullptr;
+
+    std::vector<uint8_t> rec;
+    sgtrace_begin_record(rec, SGTRACE_OP_MAKE_PIPELINE);
+    sgtrace_put(rec, result.id);
+    sgtrace_put(rec, d);
+    sgtrace_end_record(rec, 0);
+    sgtrace_track(SGTRACE_OP_MAKE_PIPELINE, result.id, std::move(rec));
+}
+
+inline void sgtrace_destroy_buffer(sg_buffer buf, void*) {
+    sgtrace_untrack(SGTRACE_OP_MAKE_BUFFER, SGTRACE_OP_DESTROY_BUFFER, buf.id);
+}
+
+inline void sgtrace_destroy_image(sg_image img, void*) {
+    sgtrace_untrack(SGTRACE_OP_MAKE_IMAGE, SGTRACE_OP_DESTROY_IMAGE, img.id);
+}
+
+inline void sgtrace_destroy_sampler(sg_sampler smp, void*) {
+    sgtrace_untrack(SGTRACE_OP_MAKE_SAMPLER, SGTRACE_OP_DESTROY_SAMPLER, smp.id);
+}
+
+inline void sgtrace_destroy_shader(sg_shader shd, void*) {
+    sgtrace_untrack(SGTRACE_OP_MAKE_SHADER, SGTRACE_OP_DESTROY_SHADER, shd.id);
+}
+
+inline void sgtrace_destroy_pipeline(sg_pipeline pip, void*) {
+    sgtrace_untrack(SGTRACE_OP_MAKE_PIPELINE, SGTRACE_OP_DESTROY_PIPELINE, pip.id);
+}
+
+inline void sgtrace_update_buffer(sg_buffer buf, const sg_range* data, void*) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    size_t start = s.frame.size();
+    sgtrace_begin_record(s.frame, SGTRACE_OP_UPDATE_BUFFER);
+    sgtrace_put(s.frame, buf.id);
+    sgtrace_put(s.frame, data->ptr, data->size);
+    sgtrace_end_record(s.frame, start);
+}
+
+inline void sgtrace_append_buffer(sg_buffer buf, const sg_range* data, int, void*) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    size_t start = s.frame.size();
+    sgtrace_begin_record(s.frame, SGTRACE_OP_APPEND_BUFFER);
+    sgtrace_put(s.frame, buf.id);
+    sgtrace_put(s.frame, data->ptr, data->size);
+    sgtrace_end_record(s.frame, start);
+}
+
+inline void sgtrace_update_image(sg_image img, const sg_image_data* data, void*) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    size_t start = s.frame.size();
+    sgtrace_begin_record(s.frame, SGTRACE_OP_UPDATE_IMAGE);
+    sgtrace_put(s.frame, img.id);
+    sgtrace_put(s.frame, sgtrace_strip_image_data(*data));
+    sgtrace_put_image_pixels(s.frame, *data);
+    sgtrace_end_record(s.frame, start);
+}
+
+inline void sgtrace_rect_record(sgtrace_op op, int x, int y, int width, int height, bool origin_top_left) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    sgtrace_rect rect = { x, y, width, height, origin_top_left ? 1u : 0u };
+    size_t start = s.frame.size();
+    sgtrace_begin_record(s.frame, op);
+    sgtrace_put(s.frame, rect);
+    sgtrace_end_record(s.frame, start);
+}
+
+inline void sgtrace_apply_viewport(int x, int y, int width, int height, bool origin_top_left, void*) {
+    sgtrace_rect_record(SGTRACE_OP_APPLY_VIEWPORT, x, y, width, height, origin_top_left);
+}
+
+inline void sgtrace_apply_scissor_rect(int x, int y, int width, int height, bool origin_top_left, void*) {
+    sgtrace_rect_record(SGTRACE_OP_APPLY_SCISSOR_RECT, x, y, width, height, origin_top_left);
+}
+
+inline void sgtrace_begin_pass(const sg_pass* pass, void*) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    // attachments aren't tracked, so offscreen passes can't be replayed
+    if (pass->attachments.id != SG_INVALID_ID) {
+        sgtrace_abort("offscreen passes are not supported");
+        return;
+    }
+    sgtrace_swapchain swapchain = {};
+    swapchain.width = pass->swapchain.width;
+    swapchain.height = pass->swapchain.height;
+    swapchain.sample_count = pass->swapchain.sample_count;
+    swapchain.color_format = (uint32_t)pass->swapchain.color_format;
+    swapchain.depth_format = (uint32_t)pass->swapchain.depth_format;
+
+    size_t start = s.frame.size();
+    sgtrace_begin_record(s.frame, SGTRACE_OP_BEGIN_PASS);
+    sgtrace_put(s.frame, pass->action);
+    sgtrace_put(s.frame, swapchain);
+    sgtrace_end_record(s.frame, start);
+}
+
+inline void sgtrace_apply_pipeline(sg_pipeline pip, void*) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    size_t start = s.frame.size();
+    sgtrace_begin_record(s.frame, SGTRACE_OP_APPLY_PIPELINE);
+    sgtrace_put(s.frame, pip.id);
+    sgtrace_end_record(s.frame, start);
+}
+
+inline void sgtrace_apply_bindings(const sg_bindings* bindings, void*) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    size_t start = s.frame.size();
+    sgtrace_begin_record(s.frame, SGTRACE_OP_APPLY_BINDINGS);
+    sgtrace_put(s.frame, *bindings);
+    sgtrace_end_record(s.frame, start);
+}
+
+inline void sgtrace_apply_uniforms(int ub_slot, const sg_range* data, void*) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    size_t start = s.frame.size();
+    sgtrace_begin_record(s.frame, SGTRACE_OP_APPLY_UNIFORMS);
+    sgtrace_put(s.frame, (int32_t)ub_slot);
+    sgtrace_put(s.frame, data->ptr, data->size);
+    sgtrace_end_record(s.frame, start);
+}
+
+inline void sgtrace_draw(int base_element, int num_elements, int num_instances, void*) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    int32_t args[3] = { base_element, num_elements, num_instances };
+    size_t start = s.frame.size();
+    sgtrace_begin_record(s.frame, SGTRACE_OP_DRAW);
+    sgtrace_put(s.frame, args);
+    sgtrace_end_record(s.frame, start);
+}
+
+inline void sgtrace_end_pass(void*) {
+    sgtrace_state& s = sgtrace();
+    if (s.recording) {
+        sgtrace_begin_record(s.frame, SGTRACE_OP_END_PASS);
+    }
+}
+
+inline void sgtrace_commit(void*) {
+    sgtrace_state& s = sgtrace();
+    if (!s.recording) {
+        return;
+    }
+    sgtrace_begin_record(s.frame, SGTRACE_OP_COMMIT);
+    s.recording = false;
+
+    std::ofstream file(s.path, std::ios::binary);
+    if (file) {
+        file.write(reinterpret_cast<const char*>(s.frame.data()), (std::streamsize)s.frame.size());
+    }
+    if (file) {
+        std::cout << "captured frame to " << s.path << " (" << s.frame.size() << " bytes)" << std::endl;
+    } else {
+        std::cout << "failed to write frame capture " << s.path << std::endl;
+    }
+    s.frame.clear();
+    s.frame.shrink_to_fit();
+}
+
+// call right after sg_setup(), before any resources are created
+inline void sgtrace_setup() {
+    sg_trace_hooks hooks = {};
+    hooks.make_buffer = sgtrace_make_buffer;
+    hooks.make_image = sgtrace_make_image;
+    hooks.make_sampler = sgtrace_make_sampler;
+    hooks.make_shader = sgtrace_make_shader;
+    hooks.make_pipeline = sgtrace_make_pipeline;
+    hooks.destroy_buffer = sgtrace_destroy_buffer;
+    hooks.destroy_image = sgtrace_destroy_image;
+    hooks.destroy_sampler = sgtrace_destroy_sampler;
+    hooks.destroy_shader = sgtrace_destroy_shader;
+    hooks.destroy_pipeline = sgtrace_destroy_pipeline;
+    hooks.update_buffer = sgtrace_update_buffer;
+    hooks.append_buffer = sgtrace_append_buffer;
+    hooks.update_image = sgtrace_update_image;
+    hooks.begin_pass = sgtrace_begin_pass;
+    hooks.apply_viewport = sgtrace_apply_viewport;
+    hooks.apply_scissor_rect = sgtrace_apply_scissor_rect;
+    hooks.apply_pipeline = sgtrace_apply_pipeline;
+    hooks.apply_bindings = sgtrace_apply_bindings;
+    hooks.apply_uniforms = sgtrace_apply_uniforms;
+    hooks.draw = sgtrace_draw;
+    hooks.end_pass = sgtrace_end_pass;
+    hooks.commit = sgtrace_commit;
+    sg_install_trace_hooks(&hooks);
+}
+
+inline void sgtrace_shutdown() {
+    sgtrace_state& s = sgtrace();
+    s.live.clear();
+    s.live_seq.clear();
+    s.native.clear();
+    s.frame.clear();
+    s.recording = false;
+    s.pending = false;
+}
+
+// the next frame (from sgtrace_begin_frame() up to sg_commit()) gets written to 'path'
+inline void sgtrace_request(const char* path) {
+    sgtrace_state& s = sgtrace();
+    s.path = path;
+    s.pending = true;
+}
+
+// call at the very start of frame()
+inline void sgtrace_begin_frame() {
+    sgtrace_state& s = sgtrace();
+    if (!s.pending) {
+        return;
+    }
+    s.pending = false;
+    if (!s.native.empty()) {
+        sgtrace_abort("resources wrapping native handles are not supported");
+        return;
+    }
+    s.recording = true;
+    s.frame.clear();
+    sgtrace_put(s.frame, sgtrace_make_header(sg_query_backend()));
+    for (auto& [seq, rec] : s.live) {
+        sgtrace_put(s.frame, rec.data(), rec.size());
+    }
+    sgtrace_begin_record(s.frame, SGTRACE_OP_FRAME_START);
+}
+
+#endif // SOKOL_TRACE_HOOKS
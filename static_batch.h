@@ -0,0 +1,282 @@
+#pragma once
+// static batching: packs every static mesh of one vertex format into a shared
+// vertex buffer and a shared 32-bit index buffer, so drawing N different
+// meshes needs one sg_apply_bindings instead of N.
+//
+// each mesh gets a BatchRange (first index, index count, base vertex). the
+// sg_draw() of this sokol_gfx version has no base vertex argument, so the base
+// vertex is added to the indices when they're copied in, and every range can
+// be drawn with a plain sg_draw(first_index, index_count, 1).
+//
+// space in both buffers comes from a first-fit free list. removing meshes
+// leaves holes, which get compacted away when an allocation doesn't fit
+// anywhere even though enough space is free in total, and always before the
+// GPU buffers are built so they only hold live data.
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "sokol/sokol_gfx.h"
+
+// first-fit sub-allocator over [0, capacity) elements
+struct RangeAllocator {
+    struct Block {
+        uint32_t offset;
+        uint32_t count;
+    };
+    uint32_t capacity = 0;
+    uint32_t free_total = 0;
+    // sorted by offset, neighbouring blocks always merged
+    std::vector<Block> free_list;
+};
+
+inline bool range_alloc(RangeAllocator& a, uint32_t count, uint32_t& offset) {
+    for (size_t i = 0; i < a.free_list.size(); i++) {
+        RangeAllocator::Block& block = a.free_list[i];
+        if (block.count >= count) {
+            offset = block.offset;
+            block.offset += count;
+            block.count -= count;
+            if (block.count == 0) {
+                a.free_list.erase(a.free_list.begin() + i);
+            }
+            a.free_total -= count;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void range_free(RangeAllocator& a, uint32_t offset, uint32_t count) {
+    if (count == 0) {
+        return;
+    }
+    auto it = std::lower_bound(a.free_list.begin(), a.free_list.end(), offset,
+        [](const RangeAllocator::Block& b, uint32_t o) { return b.offset < o; });
+    it = a.free_list.insert(it, { offset, count });
+    // merge with the following block, then with the previous one
+    auto next = it + 1;
+    if (next != a.free_list.end() && it->offset + it->count == next->offset) {
+        it->count += next->count;
+        a.free_list.erase(next);
+    }
+    if (it != a.free_list.begin()) {
+        auto prev = it - 1;
+        if (prev->offset + prev->count == it->offset) {
+            prev->count += it->count;
+            a.free_list.erase(it);
+        }
+    }
+    a.free_total += count;
+}
+
+inline void range_grow(RangeAllocator& a, uint32_t capacity) {
+    if (capacity <= a.capacity) {
+        return;
+    }
+    uint32_t old_capacity = a.capacity;
+    a.capacity = capacity;
+    range_free(a, old_capacity, capacity - old_capacity);
+}
+
+// after compaction: [0, used) is taken, the rest is one free block
+inline void range_reset(RangeAllocator& a, uint32_t used) {
+    a.free_list.clear();
+    a.free_total = a.capacity - used;
+    if (a.free_total > 0) {
+        a.free_list.push_back({ used, a.free_total });
+    }
+}
+
+struct BatchRange {
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t base_vertex;
+    uint32_t vertex_count;
+};
+
+struct StaticBatch {
+    int stride = 0;  // floats per vertex
+    const char* vertex_label = nullptr;
+    const char* index_label = nullptr;
+    // CPU copies, sized to the allocators' capacity
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    RangeAllocator vertex_alloc;
+    RangeAllocator index_alloc;
+    // indexed by the handle static_batch_add() returns, removed meshes have
+    // an index_count of 0
+    std::vector<BatchRange> ranges;
+    sg_buffer vbuf{};
+    sg_buffer ibuf{};
+    bool dirty = false;
+};
+
+inline StaticBatch static_batch_make(int stride, const char* vertex_label, const char* index_label) {
+    StaticBatch batch;
+    batch.stride = stride;
+    batch.vertex_label = vertex_label;
+    batch.index_label = index_label;
+    return batch;
+}
+
+// slides all live vertex data to the front, rebasing the indices that point into it
+inline void static_batch_compact_vertices(StaticBatch& batch) {
+    std::vector<BatchRange*> live;
+    for (BatchRange& r : batch.ranges) {
+        if (r.index_count > 0) {
+            live.push_back(&r);
+        }
+    }
+    std::sort(live.begin(), live.end(), [](const BatchRange* a, const BatchRange* b) { return a->base_vertex < b->base_vertex; });
+
+    uint32_t used = 0;
+    for (BatchRange* r : live) {
+        if (r->base_vertex != used) {
+            memmove(&batch.vertices[(size_t)used * batch.stride], &batch.vertices[(size_t)r->base_vertex * batch.stride],
+                    (size_t)r->vertex_count * batch.stride * sizeof(float));
+            for (uint32_t i = r->first_index; i < r->first_index + r->index_count; i++) {
+                batch.indices[i] = batch.indices[i] - r->base_vertex + used;
+            }
+            r->base_vertex = used;
+        }
+        used += r->vertex_count;
+    }
+    range_reset(batch.vertex_alloc, used);
+    batch.dirty = true;
+}
+
+inline void static_batch_compact_indices(StaticBatch& batch) {
+    std::vector<BatchRange*> live;
+    for (BatchRange& r : batch.ranges) {
+        if (r.index_count > 0) {
+            live.push_back(&r);
+        }
+    }
+    std::sort(live.begin(), live.end(), [](const BatchRange* a, const BatchRange* b) { return a->first_index < b->first_index; });
+
+    uint32_t used = 0;
+    for (BatchRange* r : live) {
+        if (r->first_index != used) {
+            memmove(&batch.indices[used], &batch.indices[r->first_index], (size_t)r->index_count * sizeof(uint32_t));
+            r->first_index = used;
+        }
+        used += r->index_count;
+    }
+    range_reset(batch.index_alloc, used);
+    batch.dirty = true;
+}
+
+inline void static_batch_compact(StaticBatch& batch) {
+    static_batch_compact_vertices(batch);
+    static_batch_compact_indices(batch);
+}
+
+// compacts if that makes room, grows otherwise
+inline uint32_t static_batch_reserve(StaticBatch& batch, bool vertices, uint32_t count) {
+    RangeAllocator& a = vertices ? batch.vertex_alloc : batch.index_alloc;
+    uint32_t offset = 0;
+    if (range_alloc(a, count, offset)) {
+        return offset;
+    }
+    if (a.free_total >= count) {
+        if (vertices) {
+            static_batch_compact_vertices(batch);
+        } else {
+            static_batch_compact_indices(batch);
+        }
+    } else {
+        range_grow(a, std::max(a.capacity * 2, a.capacity + count));
+        if (vertices) {
+            batch.vertices.resize((size_t)a.capacity * batch.stride);
+        } else {
+            batch.indices.resize(a.capacity);
+        }
+    }
+    range_alloc(a, count, offset);
+    return offset;
+}
+
+// appends a mesh and returns its handle. non-indexed meshes (empty 'indices')
+// get a trivial 0..n-1 index list. a mesh with an index past its own vertices
+// would read another mesh's vertices out of the shared buffer, so it is
+// rejected and gets an empty range (index_count 0) that must not be drawn.
+// the GPU buffers are only rebuilt by static_batch_upload().
+inline uint32_t static_batch_add(StaticBatch& batch, const std::vector<float>& vertices, const std::vector<unsigned int>& indices) {
+    BatchRange range = {};
+    range.vertex_count = (uint32_t)(vertices.size() / batch.stride);
+    range.index_count = indices.empty() ? range.vertex_count : (uint32_t)indices.size();
+    bool valid = range.vertex_count > 0 && range.index_count > 0;
+    for (size_t i = 0; i < indices.size() && valid; i++) {
+        valid = indices[i] < range.vertex_count;
+    }
+    if (!valid) {
+        batch.ranges.push_back({});
+        return (uint32_t)batch.ranges.size() - 1;
+    }
+
+    range.base_vertex = static_batch_reserve(batch, true, range.vertex_count);
+    range.first_index = static_batch_reserve(batch, false, range.index_count);
+
+    memcpy(&batch.vertices[(size_t)range.base_vertex * batch.stride], vertices.data(),
+           (size_t)range.vertex_count * batch.stride * sizeof(float));
+    for (uint32_t i = 0; i < range.index_count; i++) {
+        uint32_t index = indices.empty() ? i : indices[i];
+        batch.indices[range.first_index + i] = index + range.base_vertex;
+    }
+
+    batch.ranges.push_back(range);
+    batch.dirty = true;
+    return (uint32_t)batch.ranges.size() - 1;
+}
+
+inline void static_batch_remove(StaticBatch& batch, uint32_t handle) {
+    BatchRange& r = batch.ranges[handle];
+    if (r.index_count == 0) {
+        return;
+    }
+    range_free(batch.vertex_alloc, r.base_vertex, r.vertex_count);
+    range_free(batch.index_alloc, r.first_index, r.index_count);
+    r = {};
+    batch.dirty = true;
+}
+
+// (re)creates the shared buffers after meshes were added, removed or moved.
+// meant for load time, the buffers are immutable. compacts first so the
+// buffers are sized to the live data, not to the CPU side's grown capacity;
+// ranges may move, so read them back from batch.ranges afterwards.
+inline void static_batch_upload(StaticBatch& batch) {
+    if (!batch.dirty) {
+        return;
+    }
+    static_batch_compact(batch);
+    batch.dirty = false;
+    sg_destroy_buffer(batch.vbuf);
+    sg_destroy_buffer(batch.ibuf);
+    batch.vbuf = {};
+    batch.ibuf = {};
+    const uint32_t vertex_count = batch.vertex_alloc.capacity - batch.vertex_alloc.free_total;
+    const uint32_t index_count = batch.index_alloc.capacity - batch.index_alloc.free_total;
+    if (vertex_count == 0 || index_count == 0) {
+        return;
+    }
+
+    sg_buffer_desc vbuf_desc = {};
+    vbuf_desc.size = (size_t)vertex_count * batch.stride * sizeof(float);
+    vbuf_desc.data = { batch.vertices.data(), vbuf_desc.size };
+    vbuf_desc.label = batch.vertex_label;
+    batch.vbuf = sg_make_buffer(&vbuf_desc);
+
+    sg_buffer_desc ibuf_desc = {};
+    ibuf_desc.usage.index_buffer = true;
+    ibuf_desc.size = (size_t)index_count * sizeof(uint32_t);
+    ibuf_desc.data = { batch.indices.data(), ibuf_desc.size };
+    ibuf_desc.label = batch.index_label;
+    batch.ibuf = sg_make_buffer(&ibuf_desc);
+}
+
+inline void static_batch_destroy(StaticBatch& batch) {
+    sg_destroy_buffer(batch.vbuf);
+    sg_destroy_buffer(batch.ibuf);
+    batch = StaticBatch();
+}
@@ -0,0 +1,328 @@
+// meshlet_test: checks the meshlet builder's limits and that the culler is
+// conservative (never drops a triangle that faces the camera and has a vertex
+// on screen) for a few hundred camera setups, that the SSE and scalar paths
+// agree, and the range merging and capping on hand-built visibility patterns.
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "meshlet.h"
+
+using namespace std;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            cout << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << endl; \
+            failures += 1; \
+        } \
+    } while (0)
+
+struct TestMesh {
+    vector<float> vertices;  // 3 pos + 2 uv
+    vector<unsigned int> indices;
+};
+
+static HMM_Vec3 position(const TestMesh& mesh, unsigned int v) {
+    const float* p = &mesh.vertices[(size_t)v * 5];
+    return HMM_V3(p[0], p[1], p[2]);
+}
+
+// unit UV sphere, all triangles CCW seen from outside
+static TestMesh make_sphere(int rings, int segments) {
+    TestMesh mesh;
+    for (int i = 0; i <= rings; i++) {
+        for (int j = 0; j <= segments; j++) {
+            float theta = 3.14159265f * i / rings;
+            float phi = 2.0f * 3.14159265f * j / segments;
+            mesh.vertices.insert(mesh.vertices.end(), { sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi), 0.0f, 0.0f });
+        }
+    }
+    auto add = [&](unsigned int a, unsigned int b, unsigned int c) {
+        HMM_Vec3 pa = position(mesh, a), pb = position(mesh, b), pc = position(mesh, c);
+        HMM_Vec3 n = HMM_Cross(HMM_SubV3(pb, pa), HMM_SubV3(pc, pa));
+        if (HMM_DotV3(n, HMM_AddV3(HMM_AddV3(pa, pb), pc)) < 0.0f) {
+            swap(b, c);
+        }
+        mesh.indices.insert(mesh.indices.end(), { a, b, c });
+    };
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < segments; j++) {
+            unsigned int a = i * (segments + 1) + j, b = a + 1, c = a + segments + 1, d = c + 1;
+            add(a, b, c);
+            add(b, d, c);
+        }
+    }
+    return mesh;
+}
+
+// same triangles in a scrambled order, so the vertex limit is what splits meshlets
+static TestMesh scramble(const TestMesh& mesh) {
+    TestMesh out = mesh;
+    uint32_t triangles = (uint32_t)mesh.indices.size() / 3;
+    for (uint32_t t = 0; t < triangles; t++) {
+        uint32_t from = (uint32_t)(((uint64_t)t * 7919) % triangles);
+        for (int k = 0; k < 3; k++) {
+            out.indices[t * 3 + k] = mesh.indices[from * 3 + k];
+        }
+    }
+    return out;
+}
+
+static void check_limits(const TestMesh& mesh, const MeshletSet& set) {
+    CHECK(set.count > 0);
+    CHECK(set.center_x.size() % 4 == 0 && set.center_x.size() >= set.count);
+    uint32_t next = 0;
+    for (uint32_t m = 0; m < set.count; m++) {
+        // contiguous, whole triangles, covering the index list in order
+        CHECK(set.first_index[m] == next);
+        CHECK(set.index_count[m] > 0 && set.index_count[m] % 3 == 0);
+        CHECK(set.index_count[m] / 3 <= MESHLET_MAX_TRIANGLES);
+        vector<unsigned int> unique;
+        for (uint32_t i = set.first_index[m]; i < set.first_index[m] + set.index_count[m]; i++) {
+            bool seen = false;
+            for (unsigned int v : unique) {
+                seen = seen || v == mesh.indices[i];
+            }
+            if (!seen) {
+                unique.push_back(mesh.indices[i]);
+            }
+            // bounding sphere holds every vertex
+            HMM_Vec3 d = HMM_SubV3(position(mesh, mesh.indices[i]), HMM_V3(set.center_x[m], set.center_y[m], set.center_z[m]));
+            CHECK(HMM_LenV3(d) <= set.radius[m] * 1.0001f + 1e-6f);
+        }
+        CHECK(unique.size() <= MESHLET_MAX_VERTICES);
+        next += set.index_count[m];
+    }
+    CHECK(next == mesh.indices.size());
+}
+
+static bool in_clip(const HMM_Mat4& mvp, HMM_Vec3 p) {
+    HMM_Vec4 c = HMM_MulM4V4(mvp, HMM_V4V(p, 1.0f));
+    // a little inside, so vertices right on a plane don't count
+    float w = c.W * 0.999f;
+    return c.W > 0.0f && fabsf(c.X) <= w && fabsf(c.Y) <= w && fabsf(c.Z) <= w;
+}
+
+// sorted, whole meshlets, merged and capped as documented, and nothing that
+// faces the camera with a vertex on screen left out
+static void check_ranges(const TestMesh& mesh, const MeshletSet& set, const HMM_Mat4& mvp, HMM_Vec3 camera,
+                         const vector<IndexRange>& ranges) {
+    CHECK(ranges.size() <= MESHLET_MAX_RANGES);
+    vector<bool> starts(mesh.indices.size() + 1, false);
+    for (uint32_t m = 0; m < set.count; m++) {
+        starts[set.first_index[m]] = true;
+    }
+    starts[mesh.indices.size()] = true;
+    for (size_t k = 0; k < ranges.size(); k++) {
+        CHECK(ranges[k].count > 0);
+        CHECK(ranges[k].first + ranges[k].count <= mesh.indices.size());
+        CHECK(starts[ranges[k].first] && starts[ranges[k].first + ranges[k].count]);
+        if (k > 0) {
+            uint32_t gap_begin = ranges[k - 1].first + ranges[k - 1].count;
+            CHECK(gap_begin < ranges[k].first);
+            uint32_t gap_meshlets = 0;
+            for (uint32_t m = 0; m < set.count; m++) {
+                gap_meshlets += set.first_index[m] >= gap_begin && set.first_index[m] < ranges[k].first;
+            }
+            CHECK(gap_meshlets > MESHLET_MERGE_GAP);
+        }
+    }
+
+    size_t r = 0;
+    for (uint32_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        HMM_Vec3 a = position(mesh, mesh.indices[i]);
+        HMM_Vec3 b = position(mesh, mesh.indices[i + 1]);
+        HMM_Vec3 c = position(mesh, mesh.indices[i + 2]);
+        HMM_Vec3 n = HMM_Cross(HMM_SubV3(b, a), HMM_SubV3(c, a));
+        float len = HMM_LenV3(n);
+        if (len <= 1e-12f) {
+            continue;
+        }
+        bool facing = HMM_DotV3(HMM_DivV3F(n, len), HMM_SubV3(camera, a)) > 1e-4f;
+        bool on_screen = in_clip(mvp, a) || in_clip(mvp, b) || in_clip(mvp, c);
+        if (!facing || !on_screen) {
+            continue;
+        }
+        while (r < ranges.size() && ranges[r].first + ranges[r].count <= i) {
+            r++;
+        }
+        CHECK(r < ranges.size() && ranges[r].first <= i);
+    }
+}
+
+static bool same_ranges(const vector<IndexRange>& a, const vector<IndexRange>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].first != b[i].first || a[i].count != b[i].count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void check_cameras(const TestMesh& mesh, const MeshletSet& set) {
+    HMM_Mat4 projection = HMM_Perspective_RH_NO(HMM_AngleDeg(60.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+    for (int k = 0; k < 300; k++) {
+        // cameras all around the mesh, some close enough to only see part of it,
+        // aimed a bit off center so the frustum cuts through it
+        float yaw = 0.37f * k, pitch = 1.3f * sinf(0.71f * k), distance = 1.3f + 0.02f * (k % 200);
+        HMM_Vec3 eye = HMM_MulV3F(HMM_V3(cosf(pitch) * cosf(yaw), sinf(pitch), cosf(pitch) * sinf(yaw)), distance);
+        HMM_Vec3 target = HMM_V3(0.4f * sinf(1.9f * k), 0.4f * cosf(1.3f * k), 0.4f * sinf(0.7f * k));
+        HMM_Mat4 view = HMM_LookAt_RH(eye, target, HMM_V3(0.0f, 1.0f, 0.0f));
+
+        // non-uniform scale, the culler works in local space
+        HMM_Mat4 model = (k % 2 == 0) ? HMM_M4D(1.0f) : HMM_MulM4(HMM_Translate(HMM_V3(0.2f, -0.1f, 0.3f)), HMM_Scale(HMM_V3(1.0f, 1.6f, 0.7f)));
+        HMM_Mat4 mvp = HMM_MulM4(projection, HMM_MulM4(view, model));
+        HMM_Vec3 camera = HMM_MulM4V4(HMM_InvGeneralM4(model), HMM_V4V(eye, 1.0f)).XYZ;
+
+        vector<IndexRange> simd, scalar;
+        cull_meshlets(set, mvp, camera, simd);
+        cull_meshlets(set, mvp, camera, scalar, true);
+        CHECK(same_ranges(simd, scalar));
+        check_ranges(mesh, set, mvp, camera, simd);
+
+#if defined(MESHLET_SSE)
+        float planes[6][4];
+        meshlet_frustum_planes(mvp, planes);
+        for (uint32_t base = 0; base < set.count; base += 4) {
+            CHECK(meshlet_visible4_sse(set, base, planes, camera) == meshlet_visible4_scalar(set, base, planes, camera));
+        }
+#endif
+    }
+}
+
+// meshlet m is one triangle at indices 3m..3m+2, visible or not regardless of the camera
+static MeshletSet make_pattern(const vector<bool>& visible) {
+    MeshletSet set;
+    for (uint32_t m = 0; m < visible.size(); m++) {
+        set.center_x.push_back(0.0f);
+        set.center_y.push_back(0.0f);
+        set.center_z.push_back(0.0f);
+        set.radius.push_back(visible[m] ? 1e30f : -FLT_MAX);
+        set.axis_x.push_back(0.0f);
+        set.axis_y.push_back(0.0f);
+        set.axis_z.push_back(0.0f);
+        set.cutoff.push_back(1.0f);
+        set.first_index.push_back(m * 3);
+        set.index_count.push_back(3);
+        set.count += 1;
+    }
+    while (set.center_x.size() % 4 != 0) {
+        set.center_x.push_back(0.0f);
+        set.center_y.push_back(0.0f);
+        set.center_z.push_back(0.0f);
+        set.radius.push_back(-FLT_MAX);
+        set.axis_x.push_back(0.0f);
+        set.axis_y.push_back(0.0f);
+        set.axis_z.push_back(0.0f);
+        set.cutoff.push_back(1.0f);
+    }
+    return set;
+}
+
+// 'count' visible meshlets, each followed by 'gap' culled ones
+static vector<IndexRange> cull_pattern(uint32_t count, uint32_t gap) {
+    vector<bool> visible;
+    for (uint32_t i = 0; i < count; i++) {
+        visible.push_back(true);
+        visible.insert(visible.end(), gap, false);
+    }
+    MeshletSet set = make_pattern(visible);
+    vector<IndexRange> simd, scalar;
+    cull_meshlets(set, HMM_M4D(1.0f), HMM_V3(0.0f, 0.0f, 5.0f), simd);
+    cull_meshlets(set, HMM_M4D(1.0f), HMM_V3(0.0f, 0.0f, 5.0f), scalar, true);
+    CHECK(same_ranges(simd, scalar));
+    return simd;
+}
+
+static void check_merging() {
+    const uint32_t many = (uint32_t)MESHLET_MAX_RANGES + 8;
+    const uint32_t stride = MESHLET_MERGE_GAP + 2;  // one visible, MERGE_GAP + 1 culled
+
+    // short gaps get drawn over
+    vector<IndexRange> ranges = cull_pattern(many, MESHLET_MERGE_GAP);
+    CHECK(ranges.size() == 1);
+    CHECK(ranges.size() == 1 && ranges[0].first == 0 && ranges[0].count == ((many - 1) * (MESHLET_MERGE_GAP + 1) + 1) * 3);
+
+    // longer ones split the draw
+    ranges = cull_pattern(10, MESHLET_MERGE_GAP + 1);
+    CHECK(ranges.size() == 10);
+    for (uint32_t i = 0; i < ranges.size(); i++) {
+        CHECK(ranges[i].first == i * stride * 3 && ranges[i].count == 3);
+    }
+
+    // up to the cap
+    ranges = cull_pattern((uint32_t)MESHLET_MAX_RANGES, MESHLET_MERGE_GAP + 1);
+    CHECK(ranges.size() == MESHLET_MAX_RANGES);
+
+    // past it, one range from the first visible meshlet to the last
+    ranges = cull_pattern((uint32_t)MESHLET_MAX_RANGES + 1, MESHLET_MERGE_GAP + 1);
+    CHECK(ranges.size() == 1);
+    ranges = cull_pattern(many, MESHLET_MERGE_GAP + 1);
+    CHECK(ranges.size() == 1);
+    CHECK(ranges.size() == 1 && ranges[0].first == 0 && ranges[0].count == ((many - 1) * stride + 1) * 3);
+
+    // nothing visible, nothing drawn
+    MeshletSet hidden = make_pattern(vector<bool>(9, false));
+    ranges.clear();
+    cull_meshlets(hidden, HMM_M4D(1.0f), HMM_V3(0.0f, 0.0f, 5.0f), ranges);
+    CHECK(ranges.empty());
+}
+
+int main() {
+    TestMesh sphere = make_sphere(48, 96);
+    TestMesh scrambled = scramble(sphere);
+
+    MeshletSet sphere_set, scrambled_set;
+    CHECK(build_meshlets(sphere.vertices, 5, sphere.indices, sphere_set));
+    CHECK(build_meshlets(scrambled.vertices, 5, scrambled.indices, scrambled_set));
+    check_limits(sphere, sphere_set);
+    check_limits(scrambled, scrambled_set);
+
+    // out of range indices are refused, not handed to the draw
+    MeshletSet broken;
+    vector<unsigned int> bad_indices = sphere.indices;
+    bad_indices[100] = (unsigned int)(sphere.vertices.size() / 5);
+    CHECK(!build_meshlets(sphere.vertices, 5, bad_indices, broken));
+    CHECK(broken.count == 0);
+
+    check_cameras(sphere, sphere_set);
+    check_cameras(scrambled, scrambled_set);
+
+    // facing the sphere from outside, the far side's meshlets are culled
+    HMM_Mat4 projection = HMM_Perspective_RH_NO(HMM_AngleDeg(60.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+    HMM_Mat4 mvp = HMM_MulM4(projection, HMM_LookAt_RH(HMM_V3(0.0f, 0.0f, 4.0f), HMM_V3(0.0f, 0.0f, 0.0f), HMM_V3(0.0f, 1.0f, 0.0f)));
+    float planes[6][4];
+    meshlet_frustum_planes(mvp, planes);
+    uint32_t visible = 0;
+    for (uint32_t base = 0; base < sphere_set.count; base += 4) {
+        int mask = meshlet_visible4_scalar(sphere_set, base, planes, HMM_V3(0.0f, 0.0f, 4.0f));
+        for (uint32_t lane = 0; lane < 4 && base + lane < sphere_set.count; lane++) {
+            visible += (mask >> lane) & 1;
+        }
+    }
+    CHECK(visible > 0 && visible < sphere_set.count);
+
+    // looking away from it, nothing is drawn
+    mvp = HMM_MulM4(projection, HMM_LookAt_RH(HMM_V3(0.0f, 0.0f, 4.0f), HMM_V3(0.0f, 0.0f, 8.0f), HMM_V3(0.0f, 1.0f, 0.0f)));
+    vector<IndexRange> ranges;
+    cull_meshlets(sphere_set, mvp, HMM_V3(0.0f, 0.0f, 4.0f), ranges);
+    CHECK(ranges.empty());
+
+    check_merging();
+
+    if (failures > 0) {
+        cout << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "meshlet_test passed (" << sphere_set.count << " and " << scrambled_set.count << " meshlets, "
+         << visible << " facing the camera)" << endl;
+    return 0;
+}
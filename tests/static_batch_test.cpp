@@ -0,0 +1,121 @@
+// static_batch_test: adds and removes meshes in a pattern that fragments both
+// free lists, then checks that every live mesh still resolves to its own
+// vertices through the shared index buffer, across growth, compaction and the
+// upload to (dummy backend) GPU buffers.
+#define SOKOL_IMPL
+#define SOKOL_DUMMY_BACKEND
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "sokol/sokol_gfx.h"
+#include "static_batch.h"
+
+using namespace std;
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            cout << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << endl; \
+            failures += 1; \
+        } \
+    } while (0)
+
+// vertex i of mesh 'tag' is (tag, i, 0, 0, 0), its index list is i * 7 % n
+// twice over, so a rebased index that lands in the wrong mesh shows up
+static vector<float> make_vertices(int n, float tag) {
+    vector<float> v;
+    for (int i = 0; i < n; i++) {
+        v.insert(v.end(), { tag, (float)i, 0.0f, 0.0f, 0.0f });
+    }
+    return v;
+}
+
+static vector<unsigned int> make_indices(int n) {
+    vector<unsigned int> idx;
+    for (int i = 0; i < n * 2; i++) {
+        idx.push_back((i * 7) % n);
+    }
+    return idx;
+}
+
+static void check_live(const StaticBatch& batch, const vector<pair<uint32_t, float>>& live) {
+    for (auto [handle, tag] : live) {
+        const BatchRange& r = batch.ranges[handle];
+        CHECK(r.index_count == r.vertex_count * 2);
+        for (uint32_t i = 0; i < r.index_count; i++) {
+            uint32_t v = batch.indices[r.first_index + i];
+            CHECK(v >= r.base_vertex && v < r.base_vertex + r.vertex_count);
+            CHECK(batch.vertices[(size_t)v * 5 + 0] == tag);
+            CHECK(batch.vertices[(size_t)v * 5 + 1] == (float)((i * 7) % r.vertex_count));
+        }
+    }
+}
+
+int main() {
+    sg_desc desc = {};
+    sg_setup(&desc);
+
+    StaticBatch batch = static_batch_make(5, "test-vertices", "test-indices");
+    vector<pair<uint32_t, float>> live;
+    uint32_t live_vertices = 0;
+    uint32_t live_indices = 0;
+    for (int k = 0; k < 200; k++) {
+        int n = 3 + (k * 37) % 50;
+        uint32_t handle = static_batch_add(batch, make_vertices(n, (float)k), make_indices(n));
+        live.push_back({ handle, (float)k });
+        live_vertices += n;
+        live_indices += n * 2;
+
+        // every third mesh drop an older one, leaving holes all over both buffers
+        if (k % 3 == 2) {
+            size_t j = (k * 13) % live.size();
+            const BatchRange& r = batch.ranges[live[j].first];
+            live_vertices -= r.vertex_count;
+            live_indices -= r.index_count;
+            static_batch_remove(batch, live[j].first);
+            CHECK(batch.ranges[live[j].first].index_count == 0);
+            live.erase(live.begin() + j);
+        }
+        check_live(batch, live);
+        CHECK(batch.vertex_alloc.capacity - batch.vertex_alloc.free_total == live_vertices);
+        CHECK(batch.index_alloc.capacity - batch.index_alloc.free_total == live_indices);
+    }
+    CHECK(batch.vertex_alloc.free_list.size() > 1);
+
+    // non-indexed meshes get 0..n-1
+    uint32_t plain = static_batch_add(batch, make_vertices(4, 1000.0f), {});
+    CHECK(batch.ranges[plain].index_count == 4);
+    for (uint32_t i = 0; i < 4; i++) {
+        CHECK(batch.indices[batch.ranges[plain].first_index + i] == batch.ranges[plain].base_vertex + i);
+    }
+    static_batch_remove(batch, plain);
+
+    // an index past the mesh's own vertices gets it rejected without touching the buffers
+    uint32_t free_vertices = batch.vertex_alloc.free_total;
+    uint32_t broken = static_batch_add(batch, make_vertices(3, 2000.0f), { 0, 1, 3 });
+    CHECK(batch.ranges[broken].index_count == 0);
+    CHECK(batch.vertex_alloc.free_total == free_vertices);
+
+    // upload compacts, and the GPU buffers hold exactly the live data
+    static_batch_upload(batch);
+    check_live(batch, live);
+    CHECK(batch.vertex_alloc.free_list.size() <= 1);
+    CHECK(batch.index_alloc.free_list.size() <= 1);
+    CHECK(sg_query_buffer_state(batch.vbuf) == SG_RESOURCESTATE_VALID);
+    CHECK(sg_query_buffer_state(batch.ibuf) == SG_RESOURCESTATE_VALID);
+    CHECK(sg_query_buffer_desc(batch.vbuf).size == (size_t)live_vertices * 5 * sizeof(float));
+    CHECK(sg_query_buffer_desc(batch.ibuf).size == (size_t)live_indices * sizeof(uint32_t));
+
+    static_batch_destroy(batch);
+    sg_shutdown();
+
+    if (failures > 0) {
+        cout << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "static_batch_test passed (" << live.size() << " live meshes)" << endl;
+    return 0;
+}